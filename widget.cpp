@@ -11,9 +11,19 @@
 #include <QDir>
 #include <QDateTime>
 #include <QCoreApplication>
+#include <QLocale>
+#include <QHash>
+#include <algorithm>
+#include <utility>
 
 // 定义最大并发下载数
 #define MAX_CONCURRENT_DOWNLOADS 20 // 可以根据需要调整此值
+// 预检阶段最大并发 HEAD 请求数（同一主机的请求连续发送，以复用 keep-alive 连接）
+#define MAX_CONCURRENT_PREFLIGHTS 48
+// 单个 HEAD 请求的超时时间（毫秒），避免不响应 HEAD 的服务器拖住整个预检
+#define PREFLIGHT_TIMEOUT_MS 10000
+// 字节进度显示的刷新间隔（毫秒）
+#define PROGRESS_UPDATE_INTERVAL_MS 500
 
 Widget::Widget(QWidget *parent)
     : QWidget(parent)
@@ -22,6 +32,13 @@ Widget::Widget(QWidget *parent)
     , m_totalTasksCount(0)      // 初始化总任务数为 0
     , m_completedTasksCount(0)  // 初始化已完成任务数
     , m_activeDownloadsCount(0) // 初始化活跃下载任务数
+    , m_runId(0)
+    , m_activePreflightsCount(0)
+    , m_maxFileSizeBytes(0)
+    , m_totalBytesExpected(0)
+    , m_receivedBytes(0)
+    , m_unsizedTasksCount(0)
+    , m_lastProgressUpdateMs(0)
 {
     ui->setupUi(this);
 
@@ -114,11 +131,7 @@ void Widget::on_pushButtonRefresh_clicked()
     ui->lineEditTXTpath->clear();
     ui->lineEditFolderPath->clear();
     ui->labelLog->setText("等待任务开始...");
-    m_failedDownloads.clear();
-    m_downloadQueue.clear(); // 清空下载队列
-    m_totalTasksCount = 0;
-    m_completedTasksCount = 0;
-    m_activeDownloadsCount = 0; // 重置活跃下载数
+    resetRunState();
 
     // 在刷新时关闭并重新打开日志文件
     if (m_combinedLogFile.isOpen()) {
@@ -151,6 +164,295 @@ bool Widget::isValidPath(const QString &path)
     return true;
 }
 
+// 清空上一轮的全部状态，并中止仍在进行中的 HEAD/GET 请求，释放其占用的连接
+void Widget::resetRunState()
+{
+    m_runId++; // 先使旧请求失效，abort() 同步触发的 finished 信号将被直接丢弃
+    const QList<QPointer<QNetworkReply>> staleReplies = m_activeReplies;
+    m_activeReplies.clear();
+    for (const QPointer<QNetworkReply> &reply : staleReplies) {
+        if (reply) {
+            reply->abort();
+        }
+    }
+
+    m_failedDownloads.clear();
+    m_downloadQueue.clear(); // 清空下载队列
+    m_totalTasksCount = 0;
+    m_completedTasksCount = 0;
+    m_activeDownloadsCount = 0; // 重置活跃下载数
+    m_preflightTasks.clear();
+    m_preflightDropped.clear();
+    m_pendingPreflights.clear();
+    m_activePreflightsCount = 0;
+    m_maxFileSizeBytes = 0;
+    m_totalBytesExpected = 0;
+    m_receivedBytes = 0;
+    m_unsizedTasksCount = 0;
+    m_downloadTimer.invalidate();
+    ui->labelProgress->clear();
+}
+
+// 任务未发起下载就结束时，将其从字节统计中移除
+void Widget::discardTaskBytes(const DownloadTask &task)
+{
+    if (task.contentLength > 0) {
+        m_totalBytesExpected -= task.contentLength; // 不再计入待接收字节
+    } else if (task.contentLength < 0) {
+        m_unsizedTasksCount--;
+    }
+}
+
+QUrl Widget::normalizedUrl(const QString &urlString) const
+{
+    QString processedUrlString = urlString;
+    // 如果原始URL字符串不包含 "://" (即没有明确的协议头)
+    if (!processedUrlString.contains("://", Qt::CaseInsensitive)) {
+        // 在前面添加 "http://"
+        processedUrlString.prepend("http://");
+    }
+    return QUrl(processedUrlString);
+}
+
+// 所有任务处理完毕时，写入汇总日志并关闭日志文件
+void Widget::checkAllTasksCompleted()
+{
+    if (m_completedTasksCount != m_totalTasksCount) {
+        return;
+    }
+    ui->labelLog->setText("所有任务已完成。");
+    updateProgressLabel(true);
+    if (m_combinedLogFile.isOpen()) {
+        m_combinedLogStream << "--- 所有下载任务已完成 ---\n";
+        m_combinedLogStream.flush();
+        if (!m_failedDownloads.isEmpty()) {
+            m_combinedLogStream << "\n--- 以下文件未成功下载/处理 ---\n";
+            for (const QString &failedItem : m_failedDownloads) {
+                m_combinedLogStream << failedItem << "\n";
+            }
+            m_combinedLogStream << "--------------------------------\n";
+            m_combinedLogStream.flush();
+        }
+        m_combinedLogFile.close();
+    }
+}
+
+// 根据已接收字节数和已知总字节数更新进度及剩余时间
+void Widget::updateProgressLabel(bool force)
+{
+    if (!m_downloadTimer.isValid()) {
+        return;
+    }
+    qint64 elapsedMs = m_downloadTimer.elapsed();
+    if (!force && elapsedMs - m_lastProgressUpdateMs < PROGRESS_UPDATE_INTERVAL_MS) {
+        return;
+    }
+    m_lastProgressUpdateMs = elapsedMs;
+
+    QLocale locale;
+    qint64 bytesPerSecond = elapsedMs > 0 ? m_receivedBytes * 1000 / elapsedMs : 0;
+
+    if (m_completedTasksCount == m_totalTasksCount) {
+        ui->labelProgress->setText(QString("共接收 %1，用时 %2")
+                                       .arg(locale.formattedDataSize(m_receivedBytes))
+                                       .arg(formatDuration(elapsedMs / 1000)));
+        return;
+    }
+
+    if (m_totalBytesExpected <= 0) {
+        ui->labelProgress->setText(QString("已接收 %1，速度 %2/s")
+                                       .arg(locale.formattedDataSize(m_receivedBytes))
+                                       .arg(locale.formattedDataSize(bytesPerSecond)));
+        return;
+    }
+
+    // 仍有文件大小未知时，总字节数只是下限，百分比和剩余时间都不可靠，暂不显示
+    if (m_unsizedTasksCount > 0) {
+        ui->labelProgress->setText(QString("已接收 %1 / 至少 %2，速度 %3/s（%4 个文件大小未知）")
+                                       .arg(locale.formattedDataSize(m_receivedBytes))
+                                       .arg(locale.formattedDataSize(m_totalBytesExpected))
+                                       .arg(locale.formattedDataSize(bytesPerSecond))
+                                       .arg(m_unsizedTasksCount));
+        return;
+    }
+
+    qint64 remainingBytes = qMax<qint64>(0, m_totalBytesExpected - m_receivedBytes);
+    int percent = static_cast<int>(qMin<qint64>(100, m_receivedBytes * 100 / m_totalBytesExpected));
+    QString etaText = bytesPerSecond > 0
+                          ? formatDuration(remainingBytes / bytesPerSecond)
+                          : QString("--:--:--");
+    ui->labelProgress->setText(QString("已接收 %1 / %2 (%3%)，速度 %4/s，预计剩余 %5")
+                                   .arg(locale.formattedDataSize(m_receivedBytes))
+                                   .arg(locale.formattedDataSize(m_totalBytesExpected))
+                                   .arg(percent)
+                                   .arg(locale.formattedDataSize(bytesPerSecond))
+                                   .arg(etaText));
+}
+
+// 将秒数格式化为 [N天 ]HH:mm:ss，超过 24 小时不回绕
+QString Widget::formatDuration(qint64 totalSeconds)
+{
+    qint64 days = totalSeconds / 86400;
+    qint64 hours = (totalSeconds % 86400) / 3600;
+    qint64 minutes = (totalSeconds % 3600) / 60;
+    qint64 seconds = totalSeconds % 60;
+    QString time = QString("%1:%2:%3")
+                       .arg(hours, 2, 10, QChar('0'))
+                       .arg(minutes, 2, 10, QChar('0'))
+                       .arg(seconds, 2, 10, QChar('0'));
+    return days > 0 ? QString("%1天 %2").arg(days).arg(time) : time;
+}
+
+// 启动下一批 HEAD 预检请求
+void Widget::startNextPreflight()
+{
+    while (!m_pendingPreflights.isEmpty() && m_activePreflightsCount < MAX_CONCURRENT_PREFLIGHTS) {
+        int taskIndex = m_pendingPreflights.dequeue();
+        const DownloadTask &task = m_preflightTasks.at(taskIndex);
+
+        QNetworkRequest request(normalizedUrl(task.originalUrl));
+        request.setTransferTimeout(PREFLIGHT_TIMEOUT_MS);
+        // 与下载共用 m_networkManager，预检建立的连接可直接被后续 GET 复用
+        QNetworkReply *reply = m_networkManager->head(request);
+        reply->setProperty("taskIndex", taskIndex);
+        reply->setProperty("runId", m_runId);
+        m_activeReplies.append(reply);
+
+        m_activePreflightsCount++;
+    }
+
+    if (m_pendingPreflights.isEmpty() && m_activePreflightsCount == 0) {
+        finishPreflight();
+    }
+}
+
+void Widget::onPreflightFinished(QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    // 刷新或重新开始后，旧的预检结果直接丢弃
+    if (reply->property("runId").toInt() != m_runId) {
+        return;
+    }
+    m_activeReplies.removeAll(reply);
+    m_activePreflightsCount--;
+
+    int taskIndex = reply->property("taskIndex").toInt();
+    DownloadTask &task = m_preflightTasks[taskIndex];
+
+    QVariant statusCodeVariant = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    int statusCode = statusCodeVariant.isValid() ? statusCodeVariant.toInt() : -1;
+
+    // 预检失败（如服务器不支持 HEAD）不影响下载，该任务按大小未知处理
+    if (reply->error() == QNetworkReply::NoError && statusCode >= 200 && statusCode < 300) {
+        QVariant contentTypeVariant = reply->header(QNetworkRequest::ContentTypeHeader);
+        QString contentType = contentTypeVariant.isValid() ? contentTypeVariant.toString() : "";
+        QVariant contentLengthVariant = reply->header(QNetworkRequest::ContentLengthHeader);
+        if (contentLengthVariant.isValid()) {
+            task.contentLength = contentLengthVariant.toLongLong();
+        }
+
+        if (contentType.startsWith("text/html", Qt::CaseInsensitive) ||
+            contentType.startsWith("application/xhtml+xml", Qt::CaseInsensitive)) {
+            m_combinedLogStream << QString("[%1] [跳过] 预检发现非文件内容 (HTML 页面): %2 (URL: %3)\n")
+                                       .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
+                                       .arg(contentType)
+                                       .arg(task.originalUrl);
+            ui->labelLog->setText(QString("预检：跳过 HTML 页面“%1”").arg(task.fileName));
+            m_preflightDropped[taskIndex] = true;
+            m_completedTasksCount++;
+        } else if (m_maxFileSizeBytes > 0 && task.contentLength > m_maxFileSizeBytes) {
+            QLocale locale;
+            m_combinedLogStream << QString("[%1] [跳过] 文件大小 %2 超过上限 %3: %4\n")
+                                       .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
+                                       .arg(locale.formattedDataSize(task.contentLength))
+                                       .arg(locale.formattedDataSize(m_maxFileSizeBytes))
+                                       .arg(task.originalUrl);
+            ui->labelLog->setText(QString("预检：跳过超限文件“%1”").arg(task.fileName));
+            m_failedDownloads.append(QString("文件超过大小上限 (%1): %2")
+                                         .arg(locale.formattedDataSize(task.contentLength))
+                                         .arg(task.originalUrl));
+            m_preflightDropped[taskIndex] = true;
+            m_completedTasksCount++;
+        }
+    } else {
+        m_combinedLogStream << QString("[%1] [信息] 预检未获得文件信息，将直接下载: %2 (%3)\n")
+                                   .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
+                                   .arg(task.originalUrl)
+                                   .arg(reply->error() == QNetworkReply::NoError
+                                            ? QString("状态码 %1").arg(statusCode)
+                                            : reply->errorString());
+    }
+    m_combinedLogStream.flush();
+
+    startNextPreflight();
+}
+
+// 预检完成后按文件大小重新排序：大文件优先启动，并与小文件交错，缩短整体完成时间
+void Widget::finishPreflight()
+{
+    QList<DownloadTask> sizedTasks;
+    QList<DownloadTask> unsizedTasks;
+    for (int i = 0; i < m_preflightTasks.size(); ++i) {
+        if (m_preflightDropped.at(i)) {
+            continue;
+        }
+        const DownloadTask &task = m_preflightTasks.at(i);
+        if (task.contentLength >= 0) {
+            sizedTasks.append(task);
+            m_totalBytesExpected += task.contentLength;
+        } else {
+            unsizedTasks.append(task);
+        }
+    }
+    m_preflightTasks.clear();
+    m_preflightDropped.clear();
+
+    std::stable_sort(sizedTasks.begin(), sizedTasks.end(),
+                     [](const DownloadTask &a, const DownloadTask &b) {
+                         return a.contentLength > b.contentLength;
+                     });
+
+    // 依次轮流取：已知最大的文件、大小未知的文件、已知最小的文件，使并发槽位中始终混合大、小文件。
+    // 大小未知（HEAD 失败、超时或未返回 Content-Length）的文件也可能很大，
+    // 若排在最后会重新形成单连接拖尾，因此让它们与最大的文件一起尽早开始
+    int largeIndex = 0;
+    int smallIndex = sizedTasks.size() - 1;
+    int unsizedIndex = 0;
+    while (largeIndex <= smallIndex || unsizedIndex < unsizedTasks.size()) {
+        if (largeIndex <= smallIndex) {
+            m_downloadQueue.enqueue(sizedTasks.at(largeIndex++));
+        }
+        if (unsizedIndex < unsizedTasks.size()) {
+            m_downloadQueue.enqueue(unsizedTasks.at(unsizedIndex++));
+        }
+        if (largeIndex <= smallIndex) {
+            m_downloadQueue.enqueue(sizedTasks.at(smallIndex--));
+        }
+    }
+
+    QLocale locale;
+    m_combinedLogStream << QString("[%1] [信息] 预检完成：%2 个任务待下载（%3 个大小已知，共 %4），%5 个任务已跳过。\n")
+                               .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
+                               .arg(m_downloadQueue.size())
+                               .arg(sizedTasks.size())
+                               .arg(locale.formattedDataSize(m_totalBytesExpected))
+                               .arg(m_completedTasksCount);
+    m_combinedLogStream.flush();
+
+    for (const DownloadTask &task : std::as_const(m_downloadQueue)) {
+        if (task.contentLength < 0) {
+            m_unsizedTasksCount++;
+        }
+    }
+    m_downloadTimer.start();
+    m_lastProgressUpdateMs = 0;
+    ui->labelLog->setText(QString("预检完成，开始下载 %1 个任务...").arg(m_downloadQueue.size()));
+
+    checkAllTasksCompleted(); // 所有任务都可能已在预检中被跳过
+    startNextDownload();
+}
+
 // 启动下一个下载任务
 void Widget::startNextDownload()
 {
@@ -159,14 +461,7 @@ void Widget::startNextDownload()
         DownloadTask task = m_downloadQueue.dequeue(); // 从队列中取出任务
 
         // 协议自动补全
-        QString processedUrlString = task.originalUrl;
-        // 如果原始URL字符串不包含 "://" (即没有明确的协议头)
-        if (!processedUrlString.contains("://", Qt::CaseInsensitive)) {
-            // 在前面添加 "http://"
-            processedUrlString.prepend("http://");
-        }
-
-        QUrl finalUrl(processedUrlString); // 使用处理后的字符串构造QUrl
+        QUrl finalUrl = normalizedUrl(task.originalUrl);
 
         // 重新校验URL的有效性
         if (!finalUrl.isValid()) {
@@ -178,23 +473,9 @@ void Widget::startNextDownload()
             m_failedDownloads.append(QString("下载失败: %1 (错误: 原始格式非法或补全后仍无效)").arg(task.originalUrl));
             m_combinedLogStream.flush();
             m_completedTasksCount++; // 算作一个已处理的任务
+            discardTaskBytes(task);
             // 每次同步处理完一个任务，都检查是否所有任务都已完成
-            if (m_completedTasksCount == m_totalTasksCount) {
-                ui->labelLog->setText("所有任务已完成。");
-                if (m_combinedLogFile.isOpen()) {
-                    m_combinedLogStream << "--- 所有下载任务已完成 ---\n";
-                    m_combinedLogStream.flush();
-                    if (!m_failedDownloads.isEmpty()) {
-                        m_combinedLogStream << "\n--- 以下文件未成功下载/处理 ---\n";
-                        for (const QString &failedItem : m_failedDownloads) {
-                            m_combinedLogStream << failedItem << "\n";
-                        }
-                        m_combinedLogStream << "--------------------------------\n";
-                        m_combinedLogStream.flush();
-                    }
-                    m_combinedLogFile.close();
-                }
-            }
+            checkAllTasksCompleted();
             continue; // 跳过此任务
         }
 
@@ -206,23 +487,9 @@ void Widget::startNextDownload()
             m_combinedLogStream << logMessage << "\n";
             m_completedTasksCount++; // 已存在文件也算一个已处理的任务
             m_combinedLogStream.flush();
+            discardTaskBytes(task); // 同一轮中可能已由重复的URL创建了该文件
             // 每次同步处理完一个任务，都检查是否所有任务都已完成
-            if (m_completedTasksCount == m_totalTasksCount) {
-                ui->labelLog->setText("所有任务已完成。");
-                if (m_combinedLogFile.isOpen()) {
-                    m_combinedLogStream << "--- 所有下载任务已完成 ---\n";
-                    m_combinedLogStream.flush();
-                    if (!m_failedDownloads.isEmpty()) {
-                        m_combinedLogStream << "\n--- 以下文件未成功下载/处理 ---\n";
-                        for (const QString &failedItem : m_failedDownloads) {
-                            m_combinedLogStream << failedItem << "\n";
-                        }
-                        m_combinedLogStream << "--------------------------------\n";
-                        m_combinedLogStream.flush();
-                    }
-                    m_combinedLogFile.close();
-                }
-            }
+            checkAllTasksCompleted();
             continue;
         }
 
@@ -236,23 +503,9 @@ void Widget::startNextDownload()
                 m_combinedLogStream.flush();
                 m_failedDownloads.append(QString("下载失败: 目录创建失败: %1 (URL: %2)").arg(QFileInfo(task.savePath).absolutePath()).arg(task.originalUrl));
                 m_completedTasksCount++; // 也算已处理的任务
-                // 检查是否所有任务都已完成
-                if (m_completedTasksCount == m_totalTasksCount) {
-                    ui->labelLog->setText("所有任务已完成。");
-                    if (m_combinedLogFile.isOpen()) {
-                        m_combinedLogStream << "--- 所有下载任务已完成 ---\n";
-                        m_combinedLogStream.flush();
-                        if (!m_failedDownloads.isEmpty()) {
-                            m_combinedLogStream << "\n--- 以下文件未成功下载/处理 ---\n";
-                            for (const QString &failedItem : m_failedDownloads) {
-                                m_combinedLogStream << failedItem << "\n";
-                            }
-                            m_combinedLogStream << "--------------------------------\n";
-                            m_combinedLogStream.flush();
-                        }
-                        m_combinedLogFile.close();
-                    }
-                }
+                discardTaskBytes(task);
+                // 每次同步处理完一个任务，都检查是否所有任务都已完成
+                checkAllTasksCompleted();
                 continue;
             }
         }
@@ -263,6 +516,11 @@ void Widget::startNextDownload()
         reply->setProperty("savePath", task.savePath);
         reply->setProperty("originalUrl", task.originalUrl); // 原始URL
         reply->setProperty("fileName", task.fileName);
+        reply->setProperty("runId", m_runId);
+        reply->setProperty("expectedBytes", task.contentLength);
+        reply->setProperty("receivedBytes", qint64(0));
+        m_activeReplies.append(reply);
+        connect(reply, &QNetworkReply::downloadProgress, this, &Widget::onDownloadProgress);
 
         QString logMessage = QString("[%1] [开始下载] %2 -> %3").arg(QDateTime::currentDateTime().toString("HH:mm:ss")).arg(task.originalUrl).arg(task.savePath);
         ui->labelLog->setText(QString("正在下载 %1/%2: “%3”...").arg(m_completedTasksCount + 1).arg(m_totalTasksCount).arg(task.fileName)); // 更新进度
@@ -276,11 +534,7 @@ void Widget::startNextDownload()
 void Widget::on_pushButtonConfirm_clicked()
 {
     // 在开始新任务前清空所有状态
-    m_failedDownloads.clear();
-    m_downloadQueue.clear(); // 清空上次遗留的队列
-    m_totalTasksCount = 0;
-    m_completedTasksCount = 0;
-    m_activeDownloadsCount = 0; // 重置活跃下载数
+    resetRunState();
 
     QString txtFilePath = ui->lineEditTXTpath->text();
     QString outputFolderPath = ui->lineEditFolderPath->text();
@@ -412,13 +666,66 @@ void Widget::on_pushButtonConfirm_clicked()
         return;
     }
 
+    // 启用预检时，先用 HEAD 请求获取大小和类型，完成后再排序调度下载
+    // 单个文件大小上限：预检时按 Content-Length 提前剔除，下载时按实际大小中止
+    m_maxFileSizeBytes = qint64(ui->spinBoxMaxSizeMB->value()) * 1024 * 1024;
+
+    if (ui->checkBoxPreflight->isChecked()) {
+        // 同一主机的请求连续发送，以便复用 keep-alive 连接（服务器支持时为 HTTP/2 多路复用）
+        QStringList hostOrder;
+        QHash<QString, QList<int>> tasksByHost;
+        QList<DownloadTask> localTasks;
+        while (!m_downloadQueue.isEmpty()) {
+            DownloadTask task = m_downloadQueue.dequeue();
+
+            // 无效URL和本地已存在的文件无需预检，留给下载阶段按原逻辑处理；
+            // 它们不占用并发槽位、会被立即处理完，因此直接排在队首
+            QUrl url = normalizedUrl(task.originalUrl);
+            if (!url.isValid() || QFile::exists(task.savePath)) {
+                localTasks.append(task);
+                continue;
+            }
+
+            int taskIndex = m_preflightTasks.size();
+            m_preflightTasks.append(task);
+            m_preflightDropped.append(false);
+            QString host = url.host().toLower();
+            if (!tasksByHost.contains(host)) {
+                hostOrder.append(host);
+            }
+            tasksByHost[host].append(taskIndex);
+        }
+        for (const QString &host : hostOrder) {
+            for (int taskIndex : tasksByHost.value(host)) {
+                m_pendingPreflights.enqueue(taskIndex);
+            }
+        }
+        for (const DownloadTask &task : localTasks) {
+            m_downloadQueue.enqueue(task);
+        }
+
+        ui->labelLog->setText(QString("总任务数：%1，正在预检文件信息...").arg(m_totalTasksCount));
+        m_combinedLogStream << QString("[%1] [信息] 共识别 %2 个有效任务，开始预检 %3 个任务（%4 个主机）。\n")
+                                   .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
+                                   .arg(m_totalTasksCount)
+                                   .arg(m_pendingPreflights.size())
+                                   .arg(hostOrder.size());
+        m_combinedLogStream.flush();
+
+        startNextPreflight();
+        return;
+    }
+
     ui->labelLog->setText(QString("总任务数：%1，开始下载...").arg(m_totalTasksCount));
     m_combinedLogStream << QString("[%1] [信息] 共识别 %2 个有效任务，开始调度下载。\n")
                                .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
                                .arg(m_totalTasksCount);
     m_combinedLogStream.flush();
 
-    // 开始调度下载任务
+    // 开始调度下载任务；未经预检时所有任务的大小都要等 GET 开始后才知道
+    m_unsizedTasksCount = m_downloadQueue.size();
+    m_downloadTimer.start();
+    m_lastProgressUpdateMs = 0;
     startNextDownload();
 
     // 改进点 5: 移除此处关于所有任务完成的判断，该判断现在完全由 onDownloadFinished 负责
@@ -428,6 +735,19 @@ void Widget::on_pushButtonConfirm_clicked()
 
 void Widget::onDownloadFinished(QNetworkReply *reply)
 {
+    // HEAD 预检与下载共用同一个 QNetworkAccessManager，按请求类型分流
+    if (reply->operation() == QNetworkAccessManager::HeadOperation) {
+        onPreflightFinished(reply);
+        return;
+    }
+
+    // 刷新或重新开始后，上一轮遗留的下载结果直接丢弃，不计入本轮统计
+    if (reply->property("runId").toInt() != m_runId) {
+        reply->deleteLater();
+        return;
+    }
+    m_activeReplies.removeAll(reply);
+
     // 递减活跃下载数
     m_activeDownloadsCount--;
 
@@ -435,6 +755,15 @@ void Widget::onDownloadFinished(QNetworkReply *reply)
     QString originalUrl = reply->property("originalUrl").toString();
     QString fileName = reply->property("fileName").toString();
 
+    // 以实际接收量校正总字节数：失败的任务不再计入剩余量，大小未知的任务补记已接收量
+    qint64 expectedBytes = reply->property("expectedBytes").toLongLong();
+    if (expectedBytes < 0) {
+        m_unsizedTasksCount--; // 直到结束都未获得大小，已接收量即为其实际大小
+        expectedBytes = 0;
+    }
+    qint64 receivedBytes = reply->property("receivedBytes").toLongLong();
+    m_totalBytesExpected += receivedBytes - expectedBytes;
+
     QVariant statusCodeVariant = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
     int statusCode = statusCodeVariant.isValid() ? statusCodeVariant.toInt() : -1;
 
@@ -448,7 +777,22 @@ void Widget::onDownloadFinished(QNetworkReply *reply)
     // 假设默认是失败
     bool isSuccessOrSkipped = false;
 
-    if (reply->error() == QNetworkReply::NoError) {
+    if (reply->property("oversizedBytes").isValid()) {
+        // 下载过程中发现文件超过大小上限（预检未能获得大小时），已中止
+        QLocale locale;
+        qint64 oversizedBytes = reply->property("oversizedBytes").toLongLong();
+        currentFileStatusMessage = QString("跳过超限文件“%1”").arg(fileName);
+        logPrefix = "[跳过]";
+        m_combinedLogStream << QString("[%1] %2 文件大小 %3 超过上限 %4: %5\n")
+                                   .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
+                                   .arg(logPrefix)
+                                   .arg(locale.formattedDataSize(oversizedBytes))
+                                   .arg(locale.formattedDataSize(m_maxFileSizeBytes))
+                                   .arg(originalUrl);
+        failedReasonForList = QString("文件超过大小上限 (%1): %2")
+                                  .arg(locale.formattedDataSize(oversizedBytes))
+                                  .arg(originalUrl);
+    } else if (reply->error() == QNetworkReply::NoError) {
         // HTTP请求成功完成
         if (statusCode >= 200 && statusCode < 300) {
             // 检查是否是HTML页面
@@ -531,24 +875,50 @@ void Widget::onDownloadFinished(QNetworkReply *reply)
     // 根据完成进度更新 labelLog
     if (m_completedTasksCount < m_totalTasksCount) {
         ui->labelLog->setText(QString("已完成 %1/%2: %3").arg(m_completedTasksCount).arg(m_totalTasksCount).arg(currentFileStatusMessage));
+        updateProgressLabel(true);
     } else {
-        ui->labelLog->setText("所有任务已完成。");
-        if (m_combinedLogFile.isOpen()) {
-            m_combinedLogStream << "--- 所有下载任务已完成 --- \n";
-            m_combinedLogStream.flush();
-
-            if (!m_failedDownloads.isEmpty()) {
-                m_combinedLogStream << "\n--- 以下文件未成功下载/处理 ---\n";
-                for (const QString &failedItem : m_failedDownloads) {
-                    m_combinedLogStream << failedItem << "\n";
-                }
-                m_combinedLogStream << "--------------------------------\n";
-                m_combinedLogStream.flush();
-            }
-            m_combinedLogFile.close();
-        }
+        checkAllTasksCompleted();
     }
 
     // 调度下一个下载任务
     startNextDownload();
 }
+
+void Widget::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply) {
+        return;
+    }
+
+    // 上一轮遗留的下载不再需要，直接中止，避免干扰本轮的字节统计
+    if (reply->property("runId").toInt() != m_runId) {
+        reply->abort();
+        return;
+    }
+
+    // GET 响应给出的大小比预检结果更可靠，出现差异时以其为准
+    qint64 expectedBytes = reply->property("expectedBytes").toLongLong();
+    if (bytesTotal > 0 && bytesTotal != expectedBytes) {
+        if (expectedBytes < 0) {
+            m_unsizedTasksCount--;
+        }
+        m_totalBytesExpected += bytesTotal - qMax<qint64>(0, expectedBytes);
+        reply->setProperty("expectedBytes", bytesTotal);
+    }
+
+    qint64 previousBytes = reply->property("receivedBytes").toLongLong();
+    m_receivedBytes += bytesReceived - previousBytes;
+    reply->setProperty("receivedBytes", bytesReceived);
+
+    // 预检未能获得大小的文件，在下载中一旦确认超过上限即中止，不再整体读入内存
+    qint64 knownSize = qMax(bytesTotal, bytesReceived);
+    if (m_maxFileSizeBytes > 0 && knownSize > m_maxFileSizeBytes
+        && !reply->property("oversizedBytes").isValid()) {
+        reply->setProperty("oversizedBytes", knownSize);
+        reply->abort();
+        return;
+    }
+
+    updateProgressLabel();
+}
@@ -7,6 +7,8 @@
 #include <QFile>
 #include <QTextStream>
 #include <QQueue> // 新增：用于下载队列
+#include <QElapsedTimer>
+#include <QPointer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Widget; }
@@ -17,6 +19,7 @@ struct DownloadTask {
     QString originalUrl;
     QString savePath;
     QString fileName;
+    qint64 contentLength = -1; // 预检得到的文件大小，-1 表示未知
 };
 
 class Widget : public QWidget
@@ -37,10 +40,11 @@ private slots:
     void on_pushButtonShowError_clicked();
     void on_pushButtonRefresh_clicked();
     void on_pushButtonClose_clicked();
+    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
 
 private:
     Ui::Widget *ui;
-    QNetworkAccessManager *m_networkManager;
+    QNetworkAccessManager *m_networkManager; // HEAD 预检与 GET 下载共用，以复用同一连接缓存
     QFile m_combinedLogFile;
     QTextStream m_combinedLogStream;
     QString m_logFilesFolderPath;
@@ -49,10 +53,35 @@ private:
     int m_totalTasksCount;
     int m_completedTasksCount;  // 已处理完成的任务数
     int m_activeDownloadsCount; // 正在进行的下载任务数
+    int m_runId;                // 每次开始/刷新递增，用于识别并丢弃上一轮遗留的请求
+    QList<QPointer<QNetworkReply>> m_activeReplies; // 进行中的 HEAD/GET 请求，重置时统一中止
 
     QQueue<DownloadTask> m_downloadQueue; // 待下载的任务队列
 
+    // 预检阶段状态
+    QList<DownloadTask> m_preflightTasks;  // 等待预检完成后再排序的任务
+    QList<bool> m_preflightDropped;        // 对应任务是否已在预检中被剔除
+    QQueue<int> m_pendingPreflights;       // 待发送 HEAD 请求的任务下标（按主机分组）
+    int m_activePreflightsCount;           // 正在进行的 HEAD 请求数
+    qint64 m_maxFileSizeBytes;             // 单个文件大小上限，0 表示不限
+
+    // 字节级进度与剩余时间估算
+    qint64 m_totalBytesExpected; // 已知大小的文件总字节数
+    qint64 m_receivedBytes;      // 已接收的字节数
+    int m_unsizedTasksCount;     // 排队中或进行中、大小尚未计入总字节数的任务数
+    QElapsedTimer m_downloadTimer;
+    qint64 m_lastProgressUpdateMs;
+
     bool isValidPath(const QString &path);
+    void resetRunState();
+    void discardTaskBytes(const DownloadTask &task);
+    QUrl normalizedUrl(const QString &urlString) const; // 协议自动补全
     void startNextDownload(); // 新增：开始下一个下载任务的函数
+    void startNextPreflight();
+    void onPreflightFinished(QNetworkReply *reply);
+    void finishPreflight();
+    void checkAllTasksCompleted();
+    void updateProgressLabel(bool force = false);
+    static QString formatDuration(qint64 totalSeconds);
 };
 #endif // WIDGET_H